@@ -0,0 +1,662 @@
+///
+/// @file Document.cpp
+/// @author Hagen Kaye <hagen.kaye@gmail.com>
+///
+/// @section LICENSE
+/// MIT License
+///
+/// Copyright (c) 2016 Hagen Kaye
+///
+/// Permission is hereby granted, free of charge, to any person obtaining a copy
+/// of this software and associated documentation files (the "Software"), to deal
+/// in the Software without restriction, including without limitation the rights
+/// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+/// copies of the Software, and to permit persons to whom the Software is
+/// furnished to do so, subject to the following conditions:
+///
+/// The above copyright notice and this permission notice shall be included in all
+/// copies or substantial portions of the Software.
+///
+/// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+/// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+/// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+/// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+/// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+/// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+/// SOFTWARE.
+///
+/// @section DESCRIPTION
+///
+/// A class that holds the lines of a file being edited
+///
+#include "Document.h"
+#include "FileWatcher.h"
+#include "Utilities.h"
+
+#include <algorithm>
+
+using namespace Util;
+
+static const size_t szChunkSize = 1024 * 1024;
+static const size_t szTailWindow = 4096;
+static const size_t szNoMatch = std::numeric_limits<size_t>::max();
+
+class DocumentImpl : public Document
+{
+public:
+    DocumentImpl()
+        : m_pLines(make_shared<LineBuffers>())
+        , m_dev(0)
+        , m_ino(0)
+        , m_szFileSize(0)
+        , m_szTailOffset(0)
+        , m_bTailPartial(false)
+        , m_bConflict(false)
+        , m_uHeadHash(0)
+        , m_uTailHash(0)
+    {
+        ::memset(&m_mtime, 0, sizeof(m_mtime));
+        ::memset(&m_ctime, 0, sizeof(m_ctime));
+        ::memset(&m_readTime, 0, sizeof(m_readTime));
+    }
+
+    virtual bool Load(const char *pkcFilename) override
+    {
+        int fd = ::open(pkcFilename, O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+        {
+            return false;
+        }
+
+        LineBuffers lines;
+        bool bOk = readFile(fd, 0, lines);
+        ::close(fd);
+        if (!bOk)
+        {
+            return false;
+        }
+
+        m_pLines->swap(lines);
+        m_bConflict = false;
+        m_filename = pkcFilename;
+        m_pWatcher = FileWatcher::Create(pkcFilename);
+        return true;
+    }
+
+    virtual bool Reload(bool bDiscardChanges) override
+    {
+        if (m_filename.empty())
+        {
+            return false;
+        }
+
+        int fd = ::open(m_filename.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+        {
+            return false;
+        }
+
+        struct stat st;
+        bool bOk = ::fstat(fd, &st) == 0;
+        if (bOk && !isUnchanged(st))
+        {
+            // reading just the tail leaves edits to earlier lines alone, which
+            // isn't what discarding them asks for
+            bool bAppended = isAppended(fd, st);
+            if (bAppended && bDiscardChanges && isModified())
+            {
+                bAppended = false;
+            }
+            if (!bDiscardChanges && (bAppended ? isTailModified() : isModified()))
+            {
+                m_bConflict = true;
+                ::close(fd);
+                return false;
+            }
+            bOk = bAppended ? reloadTail(fd) : reloadAll(fd);
+            m_bConflict = m_bConflict && !bOk;
+        }
+        ::close(fd);
+        return bOk;
+    }
+
+    virtual bool HasConflict() const override
+    {
+        return m_bConflict;
+    }
+
+    virtual bool CheckForChanges() override
+    {
+        if (m_pWatcher && m_pWatcher->HasChanged())
+        {
+            return Reload(false);
+        }
+        return false;
+    }
+
+    virtual int GetWatchFd() const override
+    {
+        return m_pWatcher ? m_pWatcher->GetFd() : -1;
+    }
+
+    virtual LineBuffersPtr GetLineBuffers() override
+    {
+        return m_pLines;
+    }
+
+protected:
+    ///
+    /// reads from szOffset to the end of the file and appends the lines to rLines,
+    /// records the size, identity, head and tail of the file for later reloads
+    ///
+    /// @param[in] fd file to read
+    /// @param[in] szOffset offset in the file to start reading, must be the start of a line
+    /// @param[out] rLines list that the lines are appended to
+    /// @return false if the file couldn't be read
+
+    bool readFile(int fd, size_t szOffset, LineBuffers &rLines)
+    {
+        struct timespec readTime;
+        struct stat st;
+        if (::clock_gettime(CLOCK_REALTIME, &readTime) != 0 || ::fstat(fd, &st) != 0)
+        {
+            return false;
+        }
+
+        Buffer::Ptr pPrevious;
+        size_t szLeftover = 0;
+        size_t szLeftoverOffset = 0;
+        size_t szLastLineOffset = szOffset;
+        LineEnding lineEnding = NONE;
+        bool bEof = false;
+
+        while (!bEof)
+        {
+            // carry a line that didn't fit in the last chunk over into this one,
+            // reading at least as much again so a long line is only copied a
+            // few times rather than once per chunk
+            size_t szRequest = std::max(szChunkSize, szLeftover);
+            Buffer::Ptr pChunk = Buffer::Create(szLeftover + szRequest + 1);
+            char *pcChunk = pChunk->GetBuffer();
+            if (szLeftover)
+            {
+                ::memcpy(pcChunk, pPrevious->GetBuffer(szLeftoverOffset), szLeftover);
+            }
+
+            size_t szRead;
+            if (!readFully(fd, pcChunk + szLeftover, szRequest, szOffset + szLeftover, szRead))
+            {
+                return false;
+            }
+            bEof = szRead < szRequest;
+            size_t szBytes = szLeftover + szRead;
+            pcChunk[szBytes] = 0;
+
+            // the lines only hold offsets, so it's safe to give back what wasn't used
+            if (szBytes + 1 < pChunk->GetMaxSize())
+            {
+                pChunk->Reallocate(szBytes + 1);
+                pcChunk = pChunk->GetBuffer();
+            }
+
+            char *pcLine = pcChunk;
+            char *pcEnd = pcChunk + szBytes;
+            while (pcLine < pcEnd)
+            {
+                char *pcNext = nextLine(pcLine, pcEnd, lineEnding, !bEof);
+                if (pcNext == nullptr)
+                {
+                    break;
+                }
+                szLastLineOffset = szOffset + (pcLine - pcChunk);
+                rLines.push_back(LineBuffer::Create(pChunk, skipNulls(pcLine, pcNext - 1) - pcChunk));
+                pcLine = pcNext;
+            }
+
+            szLeftover = pcEnd - pcLine;
+            szLeftoverOffset = pcLine - pcChunk;
+            szOffset += szLeftoverOffset;
+            pPrevious = pChunk;
+        }
+
+        if (szLeftover)
+        {
+            // last line doesn't have a line ending, it will be read again if the file grows
+            char *pcLine = pPrevious->GetBuffer(szLeftoverOffset);
+            rLines.push_back(LineBuffer::Create(pPrevious, skipNulls(pcLine, pcLine + szLeftover) - pPrevious->GetBuffer()));
+            m_szTailOffset = szOffset;
+            m_bTailPartial = true;
+        }
+        else if (lineEnding == CR)
+        {
+            // a LF may still be on its way to make this a CRLF
+            m_szTailOffset = szLastLineOffset;
+            m_bTailPartial = true;
+        }
+        else
+        {
+            m_szTailOffset = szOffset;
+            m_bTailPartial = false;
+        }
+
+        m_dev = st.st_dev;
+        m_ino = st.st_ino;
+        m_mtime = st.st_mtim;
+        m_ctime = st.st_ctim;
+        m_readTime = readTime;
+        m_szFileSize = szOffset + szLeftover;
+        size_t szWindow = std::min(m_szFileSize, szTailWindow);
+        return hashRange(fd, 0, szWindow, m_uHeadHash) &&
+               hashRange(fd, m_szFileSize - szWindow, szWindow, m_uTailHash);
+    }
+
+    ///
+    /// skips the nulls at the start of a line
+    ///
+    /// A LineBuffer ends at the first null, so a line that starts with the
+    /// nulls a copytruncate log rotation leaves behind would show nothing of
+    /// the text written after them
+    ///
+    /// @param[in] pcLine start of the line
+    /// @param[in] pkcEnd end of the line
+    /// @return pointer to the first character that isn't a null, or pkcEnd
+
+    static char *skipNulls(char *pcLine, const char *pkcEnd)
+    {
+        while (pcLine < pkcEnd && *pcLine == 0)
+        {
+            pcLine++;
+        }
+        return pcLine;
+    }
+
+    ///
+    /// hashes a range of bytes in the file
+    ///
+    /// @param[in] fd file to read
+    /// @param[in] szOffset start of the bytes to hash
+    /// @param[in] szBytes number of bytes to hash, at most szTailWindow
+    /// @param[out] ruHash the hash
+    /// @return false if the bytes couldn't be read
+
+    bool hashRange(int fd, size_t szOffset, size_t szBytes, uint64_t &ruHash)
+    {
+        char buffer[szTailWindow];
+        size_t szRead;
+        if (!readFully(fd, buffer, szBytes, szOffset, szRead) || szRead != szBytes)
+        {
+            return false;
+        }
+        ruHash = hashBytes(buffer, szBytes);
+        return true;
+    }
+
+    ///
+    /// tests to see if the file hasn't been touched since it was read
+    ///
+    /// File times only move on every clock tick, so a write made just after
+    /// the file was read can leave them as they were.  They're only trusted
+    /// when the file was last modified well before it was read
+    ///
+    /// @param[in] rSt the current status of the file
+    /// @return true if it's the same file with the same size and times
+
+    bool isUnchanged(const struct stat &rSt) const
+    {
+        if (m_mtime.tv_sec + 1 >= m_readTime.tv_sec)
+        {
+            return false;
+        }
+        return rSt.st_dev == m_dev && rSt.st_ino == m_ino &&
+               static_cast<size_t>(rSt.st_size) == m_szFileSize &&
+               rSt.st_mtim.tv_sec == m_mtime.tv_sec && rSt.st_mtim.tv_nsec == m_mtime.tv_nsec &&
+               rSt.st_ctim.tv_sec == m_ctime.tv_sec && rSt.st_ctim.tv_nsec == m_ctime.tv_nsec;
+    }
+
+    ///
+    /// tests to see if the file has only had data appended to it since it was read
+    ///
+    /// A rewrite in place that happens to keep the same tail would pass a
+    /// check of the tail alone, so the head has to match as well
+    ///
+    /// @param[in] fd file to test
+    /// @param[in] rSt the current status of the file
+    /// @return true if it's the same file, it has grown and the bytes at the
+    ///         start and end of what was read are unchanged
+
+    bool isAppended(int fd, const struct stat &rSt)
+    {
+        if (rSt.st_dev != m_dev || rSt.st_ino != m_ino)
+        {
+            return false;
+        }
+        if (static_cast<size_t>(rSt.st_size) <= m_szFileSize)
+        {
+            return false;
+        }
+
+        size_t szWindow = std::min(m_szFileSize, szTailWindow);
+        uint64_t uHeadHash;
+        uint64_t uTailHash;
+        return hashRange(fd, 0, szWindow, uHeadHash) && uHeadHash == m_uHeadHash &&
+               hashRange(fd, m_szFileSize - szWindow, szWindow, uTailHash) && uTailHash == m_uTailHash;
+    }
+
+    ///
+    /// tests to see if any line has been modified
+    ///
+    /// @return true if a line has changes that a full reload would lose
+
+    bool isModified() const
+    {
+        for (auto &pLine : *m_pLines)
+        {
+            if (pLine->IsModified())
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    ///
+    /// tests to see if the line that an append would read again has been modified
+    ///
+    /// @return true if the last line has changes that reading the tail would lose
+
+    bool isTailModified() const
+    {
+        return m_bTailPartial && !m_pLines->empty() && m_pLines->back()->IsModified();
+    }
+
+    ///
+    /// reads just the data that was appended to the file
+    ///
+    /// @param[in] fd file to read
+    /// @return false if the file couldn't be read
+
+    bool reloadTail(int fd)
+    {
+        LineBuffers lines;
+        size_t szTailOffset = m_szTailOffset;
+        bool bTailPartial = m_bTailPartial;
+        if (!readFile(fd, szTailOffset, lines))
+        {
+            return false;
+        }
+
+        if (bTailPartial && !m_pLines->empty())
+        {
+            // the last line was read again, keep the old one if nothing was added to it
+            if (!lines.empty() && sameLine(m_pLines->back(), lines.front()))
+            {
+                lines.pop_front();
+            }
+            else
+            {
+                m_pLines->pop_back();
+            }
+        }
+        m_pLines->splice(m_pLines->end(), lines);
+        return true;
+    }
+
+    ///
+    /// reads the whole file again, keeping the LineBuffers of lines that haven't changed
+    ///
+    /// @param[in] fd file to read
+    /// @return false if the file couldn't be read
+
+    bool reloadAll(int fd)
+    {
+        LineBuffers lines;
+        if (!readFile(fd, 0, lines))
+        {
+            return false;
+        }
+
+        vector<LineBuffer::Ptr> oldLines(m_pLines->begin(), m_pLines->end());
+        vector<LineBuffer::Ptr> newLines(lines.begin(), lines.end());
+        vector<size_t> matches;
+        size_t szMatched = matchLines(oldLines, newLines, matches);
+
+        // when most of the file is unchanged, copy the few changed lines out so
+        // the chunks that were just read can be freed
+        bool bCopy = szMatched * 2 >= newLines.size();
+
+        LineBuffers result;
+        for (size_t szLine = 0; szLine < newLines.size(); szLine++)
+        {
+            if (matches[szLine] != szNoMatch)
+            {
+                // it's the same as what's on disk now, even if it was edited to get there
+                oldLines[matches[szLine]]->ClearModified();
+                result.push_back(oldLines[matches[szLine]]);
+            }
+            else if (bCopy)
+            {
+                newLines[szLine]->WriteBuffer([&result](const char *pkcBuffer, size_t szBytes)
+                {
+                    result.push_back(LineBuffer::Create(pkcBuffer));
+                });
+            }
+            else
+            {
+                result.push_back(newLines[szLine]);
+            }
+        }
+
+        m_pLines->swap(result);
+        return true;
+    }
+
+    ///
+    /// finds the lines in rNewLines that are unchanged from rOldLines
+    ///
+    /// Common lines at the start and end are matched first, then lines that
+    /// appear exactly once in both are used as anchors (keeping only those
+    /// that are in the same order) and the matches are grown out from them
+    ///
+    /// @param[in] rOldLines the lines before the reload
+    /// @param[in] rNewLines the lines after the reload
+    /// @param[out] rMatches for each new line the index of the old line it matches, or szNoMatch
+    /// @return the number of lines matched
+
+    size_t matchLines(const vector<LineBuffer::Ptr> &rOldLines, const vector<LineBuffer::Ptr> &rNewLines, vector<size_t> &rMatches)
+    {
+        size_t szOld = rOldLines.size();
+        size_t szNew = rNewLines.size();
+        size_t szMatched = 0;
+
+        vector<uint64_t> oldHashes(szOld);
+        vector<uint64_t> newHashes(szNew);
+        for (size_t sz = 0; sz < szOld; sz++)
+        {
+            oldHashes[sz] = hashLine(rOldLines[sz]);
+        }
+        for (size_t sz = 0; sz < szNew; sz++)
+        {
+            newHashes[sz] = hashLine(rNewLines[sz]);
+        }
+
+        vector<bool> oldUsed(szOld, false);
+        rMatches.assign(szNew, szNoMatch);
+
+        auto isSame = [&](size_t szOldLine, size_t szNewLine)
+        {
+            return oldHashes[szOldLine] == newHashes[szNewLine] && sameLine(rOldLines[szOldLine], rNewLines[szNewLine]);
+        };
+        auto match = [&](size_t szOldLine, size_t szNewLine)
+        {
+            rMatches[szNewLine] = szOldLine;
+            oldUsed[szOldLine] = true;
+            szMatched++;
+        };
+
+        size_t szPrefix = 0;
+        while (szPrefix < szOld && szPrefix < szNew && isSame(szPrefix, szPrefix))
+        {
+            match(szPrefix, szPrefix);
+            szPrefix++;
+        }
+        size_t szSuffix = 0;
+        while (szPrefix + szSuffix < szOld && szPrefix + szSuffix < szNew &&
+               isSame(szOld - 1 - szSuffix, szNew - 1 - szSuffix))
+        {
+            match(szOld - 1 - szSuffix, szNew - 1 - szSuffix);
+            szSuffix++;
+        }
+
+        size_t szOldEnd = szOld - szSuffix;
+        size_t szNewEnd = szNew - szSuffix;
+        if (szPrefix == szOldEnd || szPrefix == szNewEnd)
+        {
+            return szMatched;
+        }
+
+        // count each hash in the changed region, remembering where it was seen
+        unordered_map<uint64_t, pair<size_t, size_t>> oldCounts;
+        unordered_map<uint64_t, pair<size_t, size_t>> newCounts;
+        for (size_t sz = szPrefix; sz < szOldEnd; sz++)
+        {
+            pair<size_t, size_t> &rCount = oldCounts[oldHashes[sz]];
+            rCount.first++;
+            rCount.second = sz;
+        }
+        for (size_t sz = szPrefix; sz < szNewEnd; sz++)
+        {
+            pair<size_t, size_t> &rCount = newCounts[newHashes[sz]];
+            rCount.first++;
+            rCount.second = sz;
+        }
+
+        // anchors are lines that occur once in each, in new line order
+        vector<pair<size_t, size_t>> anchors;
+        for (size_t sz = szPrefix; sz < szNewEnd; sz++)
+        {
+            if (newCounts[newHashes[sz]].first != 1)
+            {
+                continue;
+            }
+            auto it = oldCounts.find(newHashes[sz]);
+            if (it != oldCounts.end() && it->second.first == 1 && isSame(it->second.second, sz))
+            {
+                anchors.push_back(make_pair(it->second.second, sz));
+            }
+        }
+
+        // keep the longest run of anchors that are also in old line order
+        vector<size_t> tails;
+        vector<size_t> previous(anchors.size(), szNoMatch);
+        for (size_t sz = 0; sz < anchors.size(); sz++)
+        {
+            auto it = std::lower_bound(tails.begin(), tails.end(), anchors[sz].first,
+                                       [&anchors](size_t szAnchor, size_t szOldLine)
+            {
+                return anchors[szAnchor].first < szOldLine;
+            });
+            if (it != tails.begin())
+            {
+                previous[sz] = *(it - 1);
+            }
+            if (it == tails.end())
+            {
+                tails.push_back(sz);
+            }
+            else
+            {
+                *it = sz;
+            }
+        }
+        vector<size_t> chain;
+        for (size_t sz = tails.empty() ? szNoMatch : tails.back(); sz != szNoMatch; sz = previous[sz])
+        {
+            chain.push_back(sz);
+        }
+        std::reverse(chain.begin(), chain.end());
+
+        for (size_t szAnchor : chain)
+        {
+            match(anchors[szAnchor].first, anchors[szAnchor].second);
+        }
+
+        // grow each anchor into the unmatched lines around it
+        for (size_t szAnchor : chain)
+        {
+            size_t szOldLine = anchors[szAnchor].first + 1;
+            size_t szNewLine = anchors[szAnchor].second + 1;
+            while (szOldLine < szOldEnd && szNewLine < szNewEnd && !oldUsed[szOldLine] &&
+                   rMatches[szNewLine] == szNoMatch && isSame(szOldLine, szNewLine))
+            {
+                match(szOldLine++, szNewLine++);
+            }
+
+            szOldLine = anchors[szAnchor].first;
+            szNewLine = anchors[szAnchor].second;
+            while (szOldLine > szPrefix && szNewLine > szPrefix && !oldUsed[szOldLine - 1] &&
+                   rMatches[szNewLine - 1] == szNoMatch && isSame(szOldLine - 1, szNewLine - 1))
+            {
+                match(--szOldLine, --szNewLine);
+            }
+        }
+
+        return szMatched;
+    }
+
+    ///
+    /// hashes the contents of a line
+    ///
+    /// @param[in] pLine the line to hash
+    /// @return the hash
+
+    static uint64_t hashLine(LineBuffer::Ptr pLine)
+    {
+        uint64_t uHash = 0;
+        pLine->WriteBuffer([&uHash](const char *pkcBuffer, size_t szBytes)
+        {
+            uHash = hashBytes(pkcBuffer, szBytes);
+        });
+        return uHash;
+    }
+
+    ///
+    /// compares the contents of two lines
+    ///
+    /// @param[in] pFirst the first line
+    /// @param[in] pSecond the second line
+    /// @return true if both lines have the same contents
+
+    static bool sameLine(LineBuffer::Ptr pFirst, LineBuffer::Ptr pSecond)
+    {
+        bool bSame = false;
+        pFirst->WriteBuffer([&bSame, pSecond](const char *pkcFirst, size_t szFirst)
+        {
+            pSecond->WriteBuffer([&bSame, pkcFirst, szFirst](const char *pkcSecond, size_t szSecond)
+            {
+                bSame = szFirst == szSecond && ::memcmp(pkcFirst, pkcSecond, szFirst) == 0;
+            });
+        });
+        return bSame;
+    }
+
+private:
+    LineBuffersPtr m_pLines;
+    string m_filename;
+    FileWatcher::Ptr m_pWatcher;
+    dev_t m_dev;
+    ino_t m_ino;
+    size_t m_szFileSize;
+    size_t m_szTailOffset;
+    bool m_bTailPartial;
+    bool m_bConflict;
+    uint64_t m_uHeadHash;
+    uint64_t m_uTailHash;
+    struct timespec m_mtime;
+    struct timespec m_ctime;
+    struct timespec m_readTime;
+};
+
+Document::Ptr Document::Create()
+{
+    return make_shared<DocumentImpl>();
+}
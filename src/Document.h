@@ -0,0 +1,121 @@
+///
+/// @file Document.h
+/// @author Hagen Kaye <hagen.kaye@gmail.com>
+///
+/// @section LICENSE
+/// MIT License
+///
+/// Copyright (c) 2016 Hagen Kaye
+///
+/// Permission is hereby granted, free of charge, to any person obtaining a copy
+/// of this software and associated documentation files (the "Software"), to deal
+/// in the Software without restriction, including without limitation the rights
+/// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+/// copies of the Software, and to permit persons to whom the Software is
+/// furnished to do so, subject to the following conditions:
+///
+/// The above copyright notice and this permission notice shall be included in all
+/// copies or substantial portions of the Software.
+///
+/// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+/// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+/// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+/// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+/// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+/// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+/// SOFTWARE.
+///
+/// @section DESCRIPTION
+///
+/// A class that holds the lines of a file being edited
+///
+#ifndef Document_h
+#define Document_h
+#include "Platform.h"
+#include "LineBuffer.h"
+
+class Document
+{
+public:
+    typedef shared_ptr<Document> Ptr;
+    typedef weak_ptr<Document> WeakPtr;
+
+    ///
+    /// Creates an empty document
+    ///
+    /// @return a shared_ptr to a Document
+
+    static Ptr Create();
+
+    ///
+    /// Loads a file into the document, replacing any existing lines
+    ///
+    /// The file is read in large chunks and each line is a LineBuffer that
+    /// refers into the chunk rather than a copy of it
+    ///
+    /// @param[in] pkcFilename path of the file to load
+    /// @return true if the file was loaded, false otherwise
+
+    virtual bool Load(const char *pkcFilename) = 0;
+
+    ///
+    /// Reloads the file after it has been changed on disk
+    ///
+    /// If the file only grew, just the new tail is read.  Otherwise the file
+    /// is read again and lines that are unchanged keep their existing
+    /// LineBuffer objects, only changed lines get new ones
+    ///
+    /// Lines that have been modified are not overwritten, if the reload would
+    /// replace any of them nothing is changed and HasConflict returns true
+    ///
+    /// @param[in] bDiscardChanges if true, every modified line is replaced by what's
+    ///            on disk, even when the file only grew
+    /// @return true if the file was reloaded, false otherwise
+
+    virtual bool Reload(bool bDiscardChanges = false) = 0;
+
+    ///
+    /// Tests to see if the last reload was refused because it would have
+    /// replaced modified lines
+    ///
+    /// @return true if the file on disk and the modified lines disagree
+
+    virtual bool HasConflict() const = 0;
+
+    ///
+    /// Checks for changes made to the file by other processes and reloads
+    /// it if there were any, does not block
+    ///
+    /// @return true if the file was reloaded, false if there were no changes
+    ///         or the reload was refused (see HasConflict)
+
+    virtual bool CheckForChanges() = 0;
+
+    ///
+    /// Get the file descriptor that becomes readable when the file changes,
+    /// is replaced or appears again at its path.  Call CheckForChanges when
+    /// it does, that drains it
+    ///
+    /// @return a file descriptor suitable for select or poll, -1 if the
+    ///         file isn't being watched
+
+    virtual int GetWatchFd() const = 0;
+
+    ///
+    /// Get the lines in the document
+    ///
+    /// The list is updated in place by Reload
+    ///
+    /// @return a shared_ptr to the list of lines
+
+    virtual LineBuffersPtr GetLineBuffers() = 0;
+
+protected:
+    ///
+    /// Destructor
+    ///
+
+    virtual ~Document() {}
+};
+
+#endif
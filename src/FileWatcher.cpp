@@ -0,0 +1,136 @@
+///
+/// @file FileWatcher.cpp
+/// @author Hagen Kaye <hagen.kaye@gmail.com>
+///
+/// @section LICENSE
+/// MIT License
+///
+/// Copyright (c) 2016 Hagen Kaye
+///
+/// Permission is hereby granted, free of charge, to any person obtaining a copy
+/// of this software and associated documentation files (the "Software"), to deal
+/// in the Software without restriction, including without limitation the rights
+/// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+/// copies of the Software, and to permit persons to whom the Software is
+/// furnished to do so, subject to the following conditions:
+///
+/// The above copyright notice and this permission notice shall be included in all
+/// copies or substantial portions of the Software.
+///
+/// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+/// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+/// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+/// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+/// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+/// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+/// SOFTWARE.
+///
+#include "FileWatcher.h"
+
+#include <sys/inotify.h>
+
+class FileWatcherImpl : public FileWatcher
+{
+public:
+    FileWatcherImpl(int fd, const char *pkcFilename)
+        : m_fd(fd)
+        , m_wd(-1)
+        , m_dirWd(-1)
+        , m_filename(pkcFilename)
+    {
+        // watch the directory too, that's the only thing that can tell us the
+        // file has come back after it was removed or renamed away
+        size_t szSlash = m_filename.rfind('/');
+        string dirname = szSlash == string::npos ? "." : (szSlash == 0 ? "/" : m_filename.substr(0, szSlash));
+        m_basename = szSlash == string::npos ? m_filename : m_filename.substr(szSlash + 1);
+        m_dirWd = ::inotify_add_watch(m_fd, dirname.c_str(), IN_CREATE | IN_MOVED_TO | IN_ONLYDIR);
+
+        addWatch();
+    }
+
+    virtual int GetFd() const override
+    {
+        return m_fd;
+    }
+
+    virtual bool HasChanged() override
+    {
+        bool bChanged = false;
+        bool bRewatch = false;
+
+        // always drain the queue, anything left in it keeps the fd readable
+        char buffer[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+        ssize_t szRead;
+        while ((szRead = ::read(m_fd, buffer, sizeof(buffer))) > 0)
+        {
+            const char *pkcEvent = buffer;
+            while (pkcEvent < buffer + szRead)
+            {
+                const struct inotify_event *pEvent = reinterpret_cast<const struct inotify_event *>(pkcEvent);
+                if (m_wd >= 0 && pEvent->wd == m_wd)
+                {
+                    bChanged = true;
+                    if (pEvent->mask & (IN_MOVE_SELF | IN_DELETE_SELF | IN_IGNORED))
+                    {
+                        bRewatch = true;
+                    }
+                }
+                else if (pEvent->wd == m_dirWd && pEvent->len && m_basename == pEvent->name)
+                {
+                    // a new file was created or moved to our path
+                    bChanged = true;
+                    bRewatch = true;
+                }
+                pkcEvent += sizeof(struct inotify_event) + pEvent->len;
+            }
+        }
+
+        if (bRewatch)
+        {
+            // the inode we were watching is no longer at our path
+            if (m_wd >= 0)
+            {
+                ::inotify_rm_watch(m_fd, m_wd);
+                m_wd = -1;
+            }
+            addWatch();
+        }
+
+        return bChanged;
+    }
+
+    ~FileWatcherImpl()
+    {
+        ::close(m_fd);
+    }
+
+protected:
+    ///
+    /// adds a watch on the file
+    ///
+    /// @return true if the file exists and is being watched
+
+    bool addWatch()
+    {
+        m_wd = ::inotify_add_watch(m_fd, m_filename.c_str(),
+                                   IN_MODIFY | IN_CLOSE_WRITE | IN_ATTRIB | IN_MOVE_SELF | IN_DELETE_SELF);
+        return m_wd >= 0;
+    }
+
+private:
+    int m_fd;
+    int m_wd;
+    int m_dirWd;
+    string m_filename;
+    string m_basename;
+};
+
+FileWatcher::Ptr FileWatcher::Create(const char *pkcFilename)
+{
+    int fd = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (fd < 0)
+    {
+        return nullptr;
+    }
+    return make_shared<FileWatcherImpl>(fd, pkcFilename);
+}
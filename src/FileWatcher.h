@@ -0,0 +1,79 @@
+///
+/// @file FileWatcher.h
+/// @author Hagen Kaye <hagen.kaye@gmail.com>
+///
+/// @section LICENSE
+/// MIT License
+///
+/// Copyright (c) 2016 Hagen Kaye
+///
+/// Permission is hereby granted, free of charge, to any person obtaining a copy
+/// of this software and associated documentation files (the "Software"), to deal
+/// in the Software without restriction, including without limitation the rights
+/// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+/// copies of the Software, and to permit persons to whom the Software is
+/// furnished to do so, subject to the following conditions:
+///
+/// The above copyright notice and this permission notice shall be included in all
+/// copies or substantial portions of the Software.
+///
+/// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+/// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+/// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+/// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+/// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+/// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+/// SOFTWARE.
+///
+/// @section DESCRIPTION
+///
+/// A class that watches a file on disk for changes made by other processes
+///
+#ifndef FileWatcher_h
+#define FileWatcher_h
+#include "Platform.h"
+
+class FileWatcher
+{
+public:
+    typedef shared_ptr<FileWatcher> Ptr;
+    typedef weak_ptr<FileWatcher> WeakPtr;
+
+    ///
+    /// Creates a watcher for a file
+    ///
+    /// The watch follows the path rather than the inode.  The file's directory
+    /// is watched as well, so a file that is replaced by a rename (log
+    /// rotation, atomic saves) or removed and created again is picked up as
+    /// soon as it appears at the path
+    ///
+    /// @param[in] pkcFilename path of the file to watch
+    /// @return a shared_ptr to a FileWatcher, null if inotify is unavailable
+
+    static Ptr Create(const char *pkcFilename);
+
+    ///
+    /// Get the file descriptor that becomes readable when there are changes
+    ///
+    /// It stays readable until HasChanged is called, which drains it
+    ///
+    /// @return a file descriptor suitable for select or poll
+
+    virtual int GetFd() const = 0;
+
+    ///
+    /// Consumes any pending change notifications, does not block
+    ///
+    /// @return true if the file was modified, replaced or removed since the last call
+
+    virtual bool HasChanged() = 0;
+
+protected:
+    ///
+    /// Destructor
+    ///
+
+    virtual ~FileWatcher() {}
+};
+
+#endif
@@ -40,6 +40,7 @@ public:
     LineBufferImpl(size_t szBytes)
         : m_bOwnsBuffer(true)
         , m_szOffsetBuffer(0)
+        , m_bModified(false)
     {
         m_pBuffer = Buffer::Create(szBytes);
     }
@@ -48,12 +49,14 @@ public:
         : m_bOwnsBuffer(bOwnsBuffer)
         , m_pBuffer(pBuffer)
         , m_szOffsetBuffer(szOffset)
+        , m_bModified(false)
     {
     }
 
     LineBufferImpl(const char *pkcBuffer)
         : m_bOwnsBuffer(true)
         , m_szOffsetBuffer(0)
+        , m_bModified(false)
     {
         m_pBuffer = Buffer::Create(::strlen(pkcBuffer) + 1);
         ::strcpy(m_pBuffer->GetBuffer(), pkcBuffer);
@@ -64,6 +67,7 @@ public:
         char *pntr = getPntrAtPos(szPos);
         Ptr pNextLine = LineBuffer::Create(pntr);
         *pntr = 0;
+        m_bModified = true;
         return pNextLine;
     }
 
@@ -89,6 +93,16 @@ public:
         });
     }
 
+    bool IsModified() const override
+    {
+        return m_bModified;
+    }
+
+    void ClearModified() override
+    {
+        m_bModified = false;
+    }
+
     ~LineBufferImpl()
     {
         m_pBuffer.reset();
@@ -125,7 +139,7 @@ protected:
 
     void expandBuffer(size_t szBytes)
     {
-        size_t szCurrentBytes = ::strlen(m_pBuffer->GetBuffer());
+        size_t szCurrentBytes = ::strlen(getPntrAtPos(0));
         reallocateBuffer(szBytes + szCurrentBytes);
     }
 
@@ -175,6 +189,7 @@ protected:
             ::memmove(pkcStart + szBytes, pkcStart, szBytesToMove);
             ::memmove(pkcStart, pkcBuffer, szBytes);
             *(pkcStart + szBytes + szBytesToMove) = 0;
+            m_bModified = true;
         }
     }
 
@@ -182,6 +197,7 @@ private:
     bool m_bOwnsBuffer;
     Buffer::Ptr m_pBuffer;
     size_t m_szOffsetBuffer;
+    bool m_bModified;
 };
 
 LineBuffer::Ptr LineBuffer::Create(size_t szBytes)
@@ -111,6 +111,20 @@ public:
 
     virtual void InsertChars(Ptr pLineBuffer, size_t szPos = std::numeric_limits<size_t>::max()) = 0;
 
+    ///
+    /// Tests to see if the LineBuffer has been changed since it was created
+    /// or since the last call to ClearModified
+    ///
+    /// @return true if the contents were changed
+
+    virtual bool IsModified() const = 0;
+
+    ///
+    /// Marks the LineBuffer as unchanged, for example after it has been saved
+    ///
+
+    virtual void ClearModified() = 0;
+
 protected:
     ///
     /// Destructor
@@ -0,0 +1,726 @@
+///
+/// @file PagedDocument.cpp
+/// @author Hagen Kaye <hagen.kaye@gmail.com>
+///
+/// @section LICENSE
+/// MIT License
+///
+/// Copyright (c) 2016 Hagen Kaye
+///
+/// Permission is hereby granted, free of charge, to any person obtaining a copy
+/// of this software and associated documentation files (the "Software"), to deal
+/// in the Software without restriction, including without limitation the rights
+/// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+/// copies of the Software, and to permit persons to whom the Software is
+/// furnished to do so, subject to the following conditions:
+///
+/// The above copyright notice and this permission notice shall be included in all
+/// copies or substantial portions of the Software.
+///
+/// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+/// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+/// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+/// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+/// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+/// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+/// SOFTWARE.
+///
+/// @section DESCRIPTION
+///
+/// A class that holds the lines of a file too large to keep in memory
+///
+#include "PagedDocument.h"
+#include "Utilities.h"
+
+#include <algorithm>
+
+using namespace Util;
+
+static const size_t szBlockSize = 1024 * 1024;
+static const size_t szScanSize = 4 * 1024 * 1024;
+
+// blocks only end on line boundaries, so this keeps a block under
+// szBlockSize + szMaxLineSize
+static const size_t szMaxLineSize = 4 * 1024 * 1024;
+
+// rough cost of a LineBuffer and its pointer on top of the text itself
+static const size_t szLineOverhead = 64;
+
+class PagedDocumentImpl : public PagedDocument
+{
+public:
+    PagedDocumentImpl(size_t szMemoryBudget)
+        : m_szMemoryBudget(szMemoryBudget)
+        , m_szMemoryUsed(0)
+        , m_szLines(0)
+        , m_fd(-1)
+        , m_dev(0)
+        , m_ino(0)
+        , m_szFileSize(0)
+    {
+        ::memset(&m_mtime, 0, sizeof(m_mtime));
+    }
+
+    virtual bool Load(const char *pkcFilename) override
+    {
+        int fd = ::open(pkcFilename, O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+        {
+            return false;
+        }
+
+        // only index what was there when we started, anything written while
+        // scanning changes the times and makes the document stale
+        struct stat st;
+        vector<Block> blocks;
+        size_t szLines = 0;
+        if (::fstat(fd, &st) != 0 || !scan(fd, st.st_size, blocks, szLines))
+        {
+            ::close(fd);
+            return false;
+        }
+
+        closeFile();
+        m_fd = fd;
+        m_filename = pkcFilename;
+        m_blocks.swap(blocks);
+        m_szLines = szLines;
+        setIdentity(st);
+        return true;
+    }
+
+    virtual bool Save() override
+    {
+        if (m_fd < 0)
+        {
+            return false;
+        }
+
+        // copying the clean blocks from a file that has changed since it was
+        // indexed would lose whatever was written to it
+        struct stat st;
+        if (IsStale() || ::fstat(m_fd, &st) != 0)
+        {
+            return false;
+        }
+
+        for (auto &rBlock : m_blocks)
+        {
+            if (rBlock.bResident && isDirty(rBlock) && !isSaveable(rBlock))
+            {
+                return false;
+            }
+        }
+
+        // write next to the original and rename over it, so the original is
+        // still there to copy unchanged blocks from.  If the path is a symlink
+        // it's the file it points to that gets replaced, not the link
+        char *pcRealname = ::realpath(m_filename.c_str(), nullptr);
+        if (pcRealname == nullptr)
+        {
+            return false;
+        }
+        string realname = pcRealname;
+        ::free(pcRealname);
+
+        string tempname = realname + ".gee-XXXXXX";
+        int fd = ::mkstemp(&tempname[0]);
+        if (fd < 0)
+        {
+            return false;
+        }
+
+        // mkstemp makes the file private, give it the original's mode and,
+        // where we're allowed to, its owner
+        bool bOk = ::fchmod(fd, st.st_mode & 07777) == 0;
+        if (::fchown(fd, st.st_uid, st.st_gid) != 0)
+        {
+            (void)::fchown(fd, -1, st.st_gid);
+        }
+
+        vector<size_t> offsets(m_blocks.size());
+        vector<size_t> sizes(m_blocks.size());
+        size_t szOffset = 0;
+        for (size_t szBlock = 0; bOk && szBlock < m_blocks.size(); szBlock++)
+        {
+            Block &rBlock = m_blocks[szBlock];
+            offsets[szBlock] = szOffset;
+            if (rBlock.bResident && isDirty(rBlock))
+            {
+                bOk = writeLines(fd, rBlock, sizes[szBlock]);
+            }
+            else
+            {
+                bOk = copyBytes(fd, rBlock.szOffset, rBlock.szBytes);
+                sizes[szBlock] = rBlock.szBytes;
+            }
+            szOffset += sizes[szBlock];
+        }
+
+        bOk = bOk && ::fsync(fd) == 0;
+        bOk = ::close(fd) == 0 && bOk;
+        if (!bOk || ::rename(tempname.c_str(), realname.c_str()) != 0)
+        {
+            ::unlink(tempname.c_str());
+            return false;
+        }
+
+        fd = ::open(m_filename.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+        {
+            return false;
+        }
+        ::close(m_fd);
+        m_fd = fd;
+        if (::fstat(m_fd, &st) == 0)
+        {
+            setIdentity(st);
+        }
+
+        // everything in memory now matches the file, so nothing is pinned
+        for (size_t szBlock = 0; szBlock < m_blocks.size(); szBlock++)
+        {
+            Block &rBlock = m_blocks[szBlock];
+            if (rBlock.bResident)
+            {
+                for (auto &pLine : rBlock.lines)
+                {
+                    pLine->ClearModified();
+                }
+                m_szMemoryUsed += sizes[szBlock];
+                m_szMemoryUsed -= rBlock.szBytes;
+            }
+            rBlock.szOffset = offsets[szBlock];
+            rBlock.szBytes = sizes[szBlock];
+            rBlock.bDirty = false;
+        }
+        evict(m_blocks.size());
+        return true;
+    }
+
+    virtual size_t GetLineCount() const override
+    {
+        return m_szLines;
+    }
+
+    virtual LineBuffer::Ptr GetLine(size_t szLine) override
+    {
+        if (szLine >= m_szLines)
+        {
+            return nullptr;
+        }
+
+        auto it = std::upper_bound(m_blocks.begin(), m_blocks.end(), szLine, [](size_t szValue, const Block &rBlock)
+        {
+            return szValue < rBlock.szFirstLine;
+        });
+        size_t szBlock = (it - m_blocks.begin()) - 1;
+        if (!materialize(szBlock))
+        {
+            return nullptr;
+        }
+        return m_blocks[szBlock].lines[szLine - m_blocks[szBlock].szFirstLine];
+    }
+
+    virtual bool IsStale() const override
+    {
+        struct stat st;
+        if (::stat(m_filename.c_str(), &st) != 0)
+        {
+            return true;
+        }
+        return st.st_dev != m_dev || st.st_ino != m_ino ||
+               static_cast<size_t>(st.st_size) != m_szFileSize ||
+               st.st_mtim.tv_sec != m_mtime.tv_sec || st.st_mtim.tv_nsec != m_mtime.tv_nsec;
+    }
+
+    virtual size_t GetMemoryUsed() const override
+    {
+        return m_szMemoryUsed;
+    }
+
+    ~PagedDocumentImpl()
+    {
+        closeFile();
+    }
+
+protected:
+    // a line with a null in it, its LineBuffer only shows the text before the
+    // null so the line is written back from the block's buffer instead
+    struct NullLine
+    {
+        size_t szLine;
+        size_t szOffset;
+        size_t szBytes;
+    };
+
+    struct Block
+    {
+        size_t szOffset;
+        size_t szBytes;
+        size_t szFirstLine;
+        size_t szLines;
+        bool bResident;
+        bool bDirty;
+        bool bIntact;
+        Buffer::Ptr pBuffer;
+        vector<LineBuffer::Ptr> lines;
+        vector<unsigned char> lineEndings;
+        vector<NullLine> nullLines;
+        list<size_t>::iterator itLru;
+    };
+
+    ///
+    /// reads through the file once to find the blocks, each block ends on a line boundary
+    ///
+    /// Stops as soon as it finds a line longer than szMaxLineSize, without the
+    /// limit a file with no line endings would be one block the size of the file
+    ///
+    /// @param[in] fd file to scan
+    /// @param[in] szFileSize number of bytes to scan
+    /// @param[out] rBlocks the blocks that were found
+    /// @param[out] rszLines the number of lines in the file
+    /// @return false if the file couldn't be read or has a line that's too long
+
+    bool scan(int fd, size_t szFileSize, vector<Block> &rBlocks, size_t &rszLines)
+    {
+        Buffer::Ptr pBuffer = Buffer::Create(szScanSize);
+        const char *pkcBuffer = pBuffer->GetBuffer();
+        size_t szOffset = 0;
+        size_t szBlockStart = 0;
+        size_t szBlockLines = 0;
+        size_t szLastLineEnd = 0;
+        bool bPreviousCR = false;
+        bool bTooLong = false;
+
+        rszLines = 0;
+        auto endLine = [&](size_t szEnd)
+        {
+            bTooLong = bTooLong || szEnd - szLastLineEnd > szMaxLineSize;
+            szLastLineEnd = szEnd;
+            szBlockLines++;
+            if (szEnd - szBlockStart >= szBlockSize)
+            {
+                addBlock(rBlocks, szBlockStart, szEnd - szBlockStart, rszLines, szBlockLines);
+                szBlockStart = szEnd;
+                szBlockLines = 0;
+            }
+        };
+
+        for (;;)
+        {
+            size_t szRead;
+            if (!readFully(fd, pBuffer->GetBuffer(), std::min(szScanSize, szFileSize - szOffset), szOffset, szRead))
+            {
+                return false;
+            }
+            if (szRead == 0)
+            {
+                break;
+            }
+
+            for (size_t sz = 0; sz < szRead; sz++)
+            {
+                char c = pkcBuffer[sz];
+                if (bPreviousCR)
+                {
+                    // a CR on its own ends the line before this character
+                    bPreviousCR = false;
+                    if (c == 0x0a)
+                    {
+                        endLine(szOffset + sz + 1);
+                        continue;
+                    }
+                    endLine(szOffset + sz);
+                }
+                if (c == 0x0d)
+                {
+                    bPreviousCR = true;
+                }
+                else if (c == 0x0a)
+                {
+                    endLine(szOffset + sz + 1);
+                }
+            }
+            szOffset += szRead;
+
+            if (bTooLong || szOffset - szLastLineEnd > szMaxLineSize)
+            {
+                return false;
+            }
+        }
+
+        if (bPreviousCR)
+        {
+            endLine(szOffset);
+        }
+        if (bTooLong)
+        {
+            return false;
+        }
+
+        // count whatever follows the last line ending as a line of its own
+        if (szLastLineEnd != szOffset)
+        {
+            szBlockLines++;
+        }
+        if (szBlockStart < szOffset)
+        {
+            addBlock(rBlocks, szBlockStart, szOffset - szBlockStart, rszLines, szBlockLines);
+        }
+        return true;
+    }
+
+    ///
+    /// adds a block to the index
+    ///
+    /// @param[in,out] rBlocks the index to add to
+    /// @param[in] szOffset offset of the block in the file
+    /// @param[in] szBytes size of the block in bytes
+    /// @param[in,out] rszFirstLine the first line of the block, advanced to the first line of the next
+    /// @param[in] szLines number of lines in the block
+
+    static void addBlock(vector<Block> &rBlocks, size_t szOffset, size_t szBytes, size_t &rszFirstLine, size_t szLines)
+    {
+        Block block;
+        block.szOffset = szOffset;
+        block.szBytes = szBytes;
+        block.szFirstLine = rszFirstLine;
+        block.szLines = szLines;
+        block.bResident = false;
+        block.bDirty = false;
+        block.bIntact = true;
+        rBlocks.push_back(block);
+        rszFirstLine += szLines;
+    }
+
+    ///
+    /// makes sure a block's lines are in memory and marks it as the most recently used
+    ///
+    /// @param[in] szBlock the block to read
+    /// @return false if the block couldn't be read
+
+    bool materialize(size_t szBlock)
+    {
+        Block &rBlock = m_blocks[szBlock];
+        if (rBlock.bResident)
+        {
+            m_lru.splice(m_lru.begin(), m_lru, rBlock.itLru);
+            return true;
+        }
+        if (IsStale())
+        {
+            return false;
+        }
+
+        Buffer::Ptr pBuffer = Buffer::Create(rBlock.szBytes + 1);
+        char *pcBuffer = pBuffer->GetBuffer();
+        if (!readBytes(pcBuffer, rBlock.szOffset, rBlock.szBytes))
+        {
+            return false;
+        }
+        pcBuffer[rBlock.szBytes] = 0;
+
+        // each line is a view into the block's buffer, it only gets a buffer
+        // of its own if it's edited
+        vector<LineBuffer::Ptr> lines;
+        vector<unsigned char> lineEndings;
+        vector<NullLine> nullLines;
+        lines.reserve(rBlock.szLines);
+        lineEndings.reserve(rBlock.szLines);
+        char *pcLine = pcBuffer;
+        char *pcEnd = pcBuffer + rBlock.szBytes;
+        LineEnding lineEnding = NONE;
+        while (pcLine < pcEnd)
+        {
+            char *pcNext = nextLine(pcLine, pcEnd, lineEnding);
+
+            char *pcLineEnd = pcNext ? pcNext - (lineEnding == CRLF ? 2 : 1) : pcEnd;
+            if (::memchr(pcLine, 0, pcLineEnd - pcLine))
+            {
+                NullLine nullLine = { lines.size(), static_cast<size_t>(pcLine - pcBuffer), static_cast<size_t>(pcLineEnd - pcLine) };
+                nullLines.push_back(nullLine);
+            }
+            lines.push_back(LineBuffer::Create(pBuffer, pcLine - pcBuffer));
+            lineEndings.push_back(lineEnding);
+            if (pcNext == nullptr)
+            {
+                break;
+            }
+            pcLine = pcNext;
+        }
+
+        // the index is what the rest of the document relies on, so if the
+        // file no longer agrees with it make it fit, but don't let it be saved
+        rBlock.bIntact = lines.size() == rBlock.szLines;
+        while (lines.size() < rBlock.szLines)
+        {
+            lines.push_back(LineBuffer::Create(static_cast<size_t>(1)));
+        }
+        lines.resize(rBlock.szLines);
+        lineEndings.resize(rBlock.szLines, LF);
+
+        rBlock.pBuffer = pBuffer;
+        rBlock.lines.swap(lines);
+        rBlock.lineEndings.swap(lineEndings);
+        rBlock.nullLines.swap(nullLines);
+        rBlock.bResident = true;
+        rBlock.itLru = m_lru.insert(m_lru.begin(), szBlock);
+        m_szMemoryUsed += blockCost(rBlock);
+
+        evict(szBlock);
+        return true;
+    }
+
+    ///
+    /// drops the least recently used blocks until the memory budget is met,
+    /// blocks that are dirty or have lines in use elsewhere are kept
+    ///
+    /// @param[in] szKeep a block that mustn't be dropped
+
+    void evict(size_t szKeep)
+    {
+        auto it = m_lru.end();
+        while (m_szMemoryUsed > m_szMemoryBudget && it != m_lru.begin())
+        {
+            --it;
+            Block &rBlock = m_blocks[*it];
+            if (*it == szKeep || isDirty(rBlock) || isInUse(rBlock))
+            {
+                continue;
+            }
+
+            m_szMemoryUsed -= blockCost(rBlock);
+            vector<LineBuffer::Ptr>().swap(rBlock.lines);
+            vector<unsigned char>().swap(rBlock.lineEndings);
+            vector<NullLine>().swap(rBlock.nullLines);
+            rBlock.pBuffer.reset();
+            rBlock.bResident = false;
+            it = m_lru.erase(it);
+        }
+    }
+
+    ///
+    /// tests to see if any of a block's lines have been changed, once it has
+    /// the block stays dirty until it's saved
+    ///
+    /// @param[in] rBlock the block to test
+    /// @return true if the block has changes that haven't been saved
+
+    bool isDirty(Block &rBlock)
+    {
+        if (!rBlock.bDirty)
+        {
+            for (auto &pLine : rBlock.lines)
+            {
+                if (pLine->IsModified())
+                {
+                    rBlock.bDirty = true;
+                    break;
+                }
+            }
+        }
+        return rBlock.bDirty;
+    }
+
+    ///
+    /// tests to see if a dirty block can be written back without losing anything
+    ///
+    /// @param[in] rBlock the block to test
+    /// @return false if the block no longer matches the index, a line with a
+    ///         null in it was changed (its LineBuffer doesn't have the whole
+    ///         line) or a line break was put into a line (the index has a fixed
+    ///         number of lines per block)
+
+    static bool isSaveable(const Block &rBlock)
+    {
+        if (!rBlock.bIntact)
+        {
+            return false;
+        }
+        for (auto &rNullLine : rBlock.nullLines)
+        {
+            if (rBlock.lines[rNullLine.szLine]->IsModified())
+            {
+                return false;
+            }
+        }
+        for (auto &pLine : rBlock.lines)
+        {
+            bool bLineBreak = false;
+            if (pLine->IsModified())
+            {
+                pLine->WriteBuffer([&bLineBreak](const char *pkcBuffer, size_t szBytes)
+                {
+                    bLineBreak = ::memchr(pkcBuffer, 0x0a, szBytes) || ::memchr(pkcBuffer, 0x0d, szBytes);
+                });
+            }
+            if (bLineBreak)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    ///
+    /// tests to see if any of a block's lines are held outside of the document
+    ///
+    /// @param[in] rBlock the block to test
+    /// @return true if a line is in use
+
+    static bool isInUse(const Block &rBlock)
+    {
+        for (auto &pLine : rBlock.lines)
+        {
+            if (pLine.use_count() > 1)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    ///
+    /// estimates the memory a block uses while it's in memory
+    ///
+    /// @param[in] rBlock the block
+    /// @return the number of bytes
+
+    static size_t blockCost(const Block &rBlock)
+    {
+        return rBlock.szBytes + rBlock.szLines * szLineOverhead;
+    }
+
+    ///
+    /// reads bytes from the file
+    ///
+    /// @param[out] pcBuffer where to put the bytes
+    /// @param[in] szOffset offset in the file
+    /// @param[in] szBytes number of bytes to read
+    /// @return false if they couldn't all be read
+
+    bool readBytes(char *pcBuffer, size_t szOffset, size_t szBytes)
+    {
+        size_t szRead;
+        return readFully(m_fd, pcBuffer, szBytes, szOffset, szRead) && szRead == szBytes;
+    }
+
+    ///
+    /// copies a block unchanged from the original file
+    ///
+    /// @param[in] fd file to write
+    /// @param[in] szOffset offset of the block in the original file
+    /// @param[in] szBytes size of the block
+    /// @return false if the copy failed
+
+    bool copyBytes(int fd, size_t szOffset, size_t szBytes)
+    {
+        char buffer[64 * 1024];
+        while (szBytes)
+        {
+            size_t szChunk = std::min(szBytes, sizeof(buffer));
+            if (!readBytes(buffer, szOffset, szChunk) || !writeFully(fd, buffer, szChunk))
+            {
+                return false;
+            }
+            szOffset += szChunk;
+            szBytes -= szChunk;
+        }
+        return true;
+    }
+
+    ///
+    /// writes out the lines of a block that has been changed
+    ///
+    /// @param[in] fd file to write
+    /// @param[in] rBlock the block to write
+    /// @param[out] rszBytes the number of bytes written
+    /// @return false if the write failed
+
+    bool writeLines(int fd, const Block &rBlock, size_t &rszBytes)
+    {
+        auto itNullLine = rBlock.nullLines.begin();
+        bool bOk = true;
+
+        rszBytes = 0;
+        for (size_t szLine = 0; bOk && szLine < rBlock.lines.size(); szLine++)
+        {
+            if (itNullLine != rBlock.nullLines.end() && itNullLine->szLine == szLine)
+            {
+                // isSaveable made sure this line hasn't been changed
+                bOk = writeFully(fd, rBlock.pBuffer->GetBuffer(itNullLine->szOffset), itNullLine->szBytes);
+                rszBytes += itNullLine->szBytes;
+                ++itNullLine;
+            }
+            else
+            {
+                rBlock.lines[szLine]->WriteBuffer([fd, &bOk, &rszBytes](const char *pkcBuffer, size_t szBytes)
+                {
+                    bOk = writeFully(fd, pkcBuffer, szBytes);
+                    rszBytes += szBytes;
+                });
+            }
+
+            // each line keeps the ending it was read with, the last line in
+            // the file may not have one
+            LineEnding lineEnding = static_cast<LineEnding>(rBlock.lineEndings[szLine]);
+            if (bOk && lineEnding != NONE)
+            {
+                const char *pkcLineEnding = lineEnding == CRLF ? "\r\n" : (lineEnding == CR ? "\r" : "\n");
+                size_t szLineEnding = ::strlen(pkcLineEnding);
+                bOk = writeFully(fd, pkcLineEnding, szLineEnding);
+                rszBytes += szLineEnding;
+            }
+        }
+        return bOk;
+    }
+
+    ///
+    /// remembers which file the index describes
+    ///
+    /// @param[in] rSt the status of the file when it was indexed
+
+    void setIdentity(const struct stat &rSt)
+    {
+        m_dev = rSt.st_dev;
+        m_ino = rSt.st_ino;
+        m_szFileSize = rSt.st_size;
+        m_mtime = rSt.st_mtim;
+    }
+
+    ///
+    /// closes the file and forgets the index
+    ///
+
+    void closeFile()
+    {
+        if (m_fd >= 0)
+        {
+            ::close(m_fd);
+            m_fd = -1;
+        }
+        m_blocks.clear();
+        m_lru.clear();
+        m_szMemoryUsed = 0;
+        m_szLines = 0;
+    }
+
+private:
+    size_t m_szMemoryBudget;
+    size_t m_szMemoryUsed;
+    size_t m_szLines;
+    int m_fd;
+    dev_t m_dev;
+    ino_t m_ino;
+    size_t m_szFileSize;
+    struct timespec m_mtime;
+    string m_filename;
+    vector<Block> m_blocks;
+    list<size_t> m_lru;
+};
+
+PagedDocument::Ptr PagedDocument::Create(size_t szMemoryBudget)
+{
+    return make_shared<PagedDocumentImpl>(szMemoryBudget);
+}
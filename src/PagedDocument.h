@@ -0,0 +1,135 @@
+///
+/// @file PagedDocument.h
+/// @author Hagen Kaye <hagen.kaye@gmail.com>
+///
+/// @section LICENSE
+/// MIT License
+///
+/// Copyright (c) 2016 Hagen Kaye
+///
+/// Permission is hereby granted, free of charge, to any person obtaining a copy
+/// of this software and associated documentation files (the "Software"), to deal
+/// in the Software without restriction, including without limitation the rights
+/// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+/// copies of the Software, and to permit persons to whom the Software is
+/// furnished to do so, subject to the following conditions:
+///
+/// The above copyright notice and this permission notice shall be included in all
+/// copies or substantial portions of the Software.
+///
+/// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+/// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+/// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+/// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+/// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+/// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+/// SOFTWARE.
+///
+/// @section DESCRIPTION
+///
+/// A class that holds the lines of a file too large to keep in memory
+///
+#ifndef PagedDocument_h
+#define PagedDocument_h
+#include "Platform.h"
+#include "LineBuffer.h"
+
+class PagedDocument
+{
+public:
+    typedef shared_ptr<PagedDocument> Ptr;
+    typedef weak_ptr<PagedDocument> WeakPtr;
+
+    ///
+    /// Creates an empty paged document
+    ///
+    /// Only an index of the file is kept, the byte offset and line count of
+    /// each block of lines.  Blocks are read when their lines are needed and
+    /// the least recently used unmodified blocks are dropped again to keep
+    /// within the memory budget.  Modified blocks stay until they're saved
+    ///
+    /// Blocks are about 1 MB and always end on a line boundary, so lines are
+    /// limited to 4 MB to keep any one block under 5 MB.  Memory use is the
+    /// budget plus at most the block being read, and whatever modified blocks
+    /// are waiting to be saved
+    ///
+    /// @param[in] szMemoryBudget bytes of blocks to keep in memory
+    /// @return a shared_ptr to a PagedDocument
+
+    static Ptr Create(size_t szMemoryBudget = 256 * 1024 * 1024);
+
+    ///
+    /// Opens a file by scanning it for line endings to build the index
+    ///
+    /// @param[in] pkcFilename path of the file to open
+    /// @return true if the file was opened, false if it couldn't be read or
+    ///         has a line longer than 4 MB, counting its line ending
+
+    virtual bool Load(const char *pkcFilename) = 0;
+
+    ///
+    /// Writes the file back, unchanged blocks are copied from the original
+    ///
+    /// A LineBuffer only holds the text up to a null, so lines with nulls in
+    /// them are written back as they were read.  If one of them was changed,
+    /// or the document is stale, nothing is saved
+    ///
+    /// The new contents go to a temporary file beside the original that is
+    /// then renamed over it, keeping its mode and owner.  A symlink is
+    /// followed, the file it points to is replaced and the link is kept
+    ///
+    /// @return true if the file was saved, false otherwise
+
+    virtual bool Save() = 0;
+
+    ///
+    /// Get the number of lines in the document
+    ///
+    /// @return the number of lines
+
+    virtual size_t GetLineCount() const = 0;
+
+    ///
+    /// Get a line, reading its block into memory if it isn't already
+    ///
+    /// A block with lines that are still referenced outside of the document
+    /// won't be dropped, so don't hold on to lines longer than needed
+    ///
+    /// The number of lines in each block is fixed, so a line has to stay a
+    /// single line.  Save refuses a line that has had a line break inserted
+    /// into it, and a line mustn't be Split since the second half has nowhere
+    /// to go and would be lost when the first half is saved
+    ///
+    /// @param[in] szLine the line number, starting at 0
+    /// @return a shared_ptr to the line, null if out of range, the document is
+    ///         stale or the line couldn't be read
+
+    virtual LineBuffer::Ptr GetLine(size_t szLine) = 0;
+
+    ///
+    /// Tests to see if the file has been changed, replaced or removed since it
+    /// was loaded or saved
+    ///
+    /// A stale document won't read blocks it doesn't already have or save,
+    /// since the index no longer describes the file.  Load it again
+    ///
+    /// @return true if the index no longer matches the file
+
+    virtual bool IsStale() const = 0;
+
+    ///
+    /// Get the memory held by blocks that are in memory
+    ///
+    /// @return the number of bytes in use
+
+    virtual size_t GetMemoryUsed() const = 0;
+
+protected:
+    ///
+    /// Destructor
+    ///
+
+    virtual ~PagedDocument() {}
+};
+
+#endif
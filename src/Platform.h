@@ -2,11 +2,22 @@
 #define Platform_h
 #include <memory>
 #include <iostream>
+#include <functional>
 #include <list>
+#include <string>
+#include <vector>
+#include <unordered_map>
 #include <limits>
 
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdlib.h>
 #include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
 
 using namespace std;
 
-#endif
\ No newline at end of file
+#endif
@@ -104,3 +104,98 @@ char *Util::nextLine(char *pcBuffer, Util::LineEnding &rLineEnding, bool bMoreTo
     return nullptr;
 }
 
+char *Util::nextLine(char *pcBuffer, const char *pkcEnd, Util::LineEnding &rLineEnding, bool bMoreToCome)
+{
+    // same as above but bounded by pkcEnd rather than a null terminator, so
+    // nulls in the text don't end the search
+    while (pcBuffer < pkcEnd)
+    {
+        if (*pcBuffer == 0x0d || *pcBuffer == 0x0a)
+        {
+            if (*pcBuffer == 0x0d)
+            {
+                if (pcBuffer + 1 < pkcEnd && pcBuffer[1] == 0x0a)
+                {
+                    rLineEnding = Util::CRLF;
+                    *pcBuffer = 0;
+                    pcBuffer++;
+                }
+                else if (bMoreToCome && pcBuffer + 1 == pkcEnd)
+                {
+                    // might be an incomplete line
+                    rLineEnding = Util::NONE;
+                    return nullptr;
+                }
+                else
+                {
+                    rLineEnding = Util::CR;
+                }
+            }
+            else
+            {
+                rLineEnding = Util::LF;
+            }
+            *pcBuffer = 0;
+            pcBuffer++;
+            return pcBuffer;
+        }
+        pcBuffer++;
+    }
+    rLineEnding = Util::NONE;
+    return nullptr;
+}
+
+bool Util::readFully(int fd, char *pcBuffer, size_t szBytes, size_t szOffset, size_t &rszRead)
+{
+    // keeps reading until szBytes have been read or the end of the file,
+    // rszRead is only less than szBytes if the end of the file was reached
+    rszRead = 0;
+    while (rszRead < szBytes)
+    {
+        ssize_t szResult = ::pread(fd, pcBuffer + rszRead, szBytes - rszRead, szOffset + rszRead);
+        if (szResult < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return false;
+        }
+        if (szResult == 0)
+        {
+            break;
+        }
+        rszRead += szResult;
+    }
+    return true;
+}
+
+bool Util::writeFully(int fd, const char *pkcBuffer, size_t szBytes)
+{
+    while (szBytes)
+    {
+        ssize_t szWritten = ::write(fd, pkcBuffer, szBytes);
+        if (szWritten < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (szWritten <= 0)
+        {
+            return false;
+        }
+        pkcBuffer += szWritten;
+        szBytes -= szWritten;
+    }
+    return true;
+}
+
+uint64_t Util::hashBytes(const char *pkcBuffer, size_t szBytes, uint64_t uHash)
+{
+    // 64 bit FNV-1a, pass the previous result as uHash to hash in pieces
+    while (szBytes--)
+    {
+        uHash ^= static_cast<unsigned char>(*pkcBuffer++);
+        uHash *= 0x100000001b3ULL;
+    }
+    return uHash;
+}
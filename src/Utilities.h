@@ -48,6 +48,10 @@ enum LineEnding
 size_t numUTF8chars(const char *pkcBuffer);
 char *advancePntrToNextUTF8char(char *pcBuffer, size_t szCount = 1);
 char *nextLine(char *pcBuffer, LineEnding &rLineEnding, bool bMoreToCome = false);
+char *nextLine(char *pcBuffer, const char *pkcEnd, LineEnding &rLineEnding, bool bMoreToCome = false);
+bool readFully(int fd, char *pcBuffer, size_t szBytes, size_t szOffset, size_t &rszRead);
+bool writeFully(int fd, const char *pkcBuffer, size_t szBytes);
+uint64_t hashBytes(const char *pkcBuffer, size_t szBytes, uint64_t uHash = 0xcbf29ce484222325ULL);
 }
 
 #endif
\ No newline at end of file
@@ -0,0 +1,314 @@
+///
+/// @file DocumentTest.cpp
+/// @author Hagen Kaye <hagen.kaye@gmail.com>
+///
+/// @section LICENSE
+/// MIT License
+///
+/// Copyright (c) 2016 Hagen Kaye
+///
+/// Permission is hereby granted, free of charge, to any person obtaining a copy
+/// of this software and associated documentation files (the "Software"), to deal
+/// in the Software without restriction, including without limitation the rights
+/// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+/// copies of the Software, and to permit persons to whom the Software is
+/// furnished to do so, subject to the following conditions:
+///
+/// The above copyright notice and this permission notice shall be included in all
+/// copies or substantial portions of the Software.
+///
+/// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+/// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+/// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+/// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+/// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+/// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+/// SOFTWARE.
+///
+#include "Test.h"
+#include "Document.h"
+
+#include <poll.h>
+#include <stdio.h>
+
+using namespace Test;
+
+static vector<LineBuffer::Ptr> lines(Document::Ptr pDocument)
+{
+    return vector<LineBuffer::Ptr>(pDocument->GetLineBuffers()->begin(), pDocument->GetLineBuffers()->end());
+}
+
+static vector<string> texts(Document::Ptr pDocument)
+{
+    vector<string> result;
+    for (auto &pLine : *pDocument->GetLineBuffers())
+    {
+        result.push_back(text(pLine));
+    }
+    return result;
+}
+
+static string join(const vector<string> &rLines)
+{
+    string contents;
+    for (auto &rLine : rLines)
+    {
+        contents += rLine + "\n";
+    }
+    return contents;
+}
+
+static void testLoad()
+{
+    string path = Test::path("load.txt");
+    writeFile(path, "lf\ncrlf\r\ncr\r\nlast");
+    Document::Ptr pDocument = Document::Create();
+    CHECK(pDocument->Load(path.c_str()));
+    CHECK(texts(pDocument) == splitLines(readFile(path)));
+    CHECK(texts(pDocument).size() == 4);
+
+    writeFile(path, "");
+    CHECK(pDocument->Load(path.c_str()));
+    CHECK(pDocument->GetLineBuffers()->empty());
+
+    CHECK(!pDocument->Load(Test::path("missing.txt").c_str()));
+}
+
+static void testChunkBoundaries()
+{
+    // the chunks are 1 MB, put a CRLF across the first boundary and a line
+    // longer than a chunk after it
+    string path = Test::path("chunks.txt");
+    string contents(1024 * 1024 - 1, 'a');
+    contents += "\r\n";
+    contents += string(3 * 1024 * 1024, 'b') + "\r" + "c\n";
+    writeFile(path, contents);
+
+    Document::Ptr pDocument = Document::Create();
+    CHECK(pDocument->Load(path.c_str()));
+    CHECK(texts(pDocument) == splitLines(contents));
+}
+
+static void testAppend()
+{
+    string path = Test::path("append.txt");
+    writeFile(path, "one\ntwo\nthr");
+    Document::Ptr pDocument = Document::Create();
+    pDocument->Load(path.c_str());
+    vector<LineBuffer::Ptr> before = lines(pDocument);
+
+    // a partial last line is finished off by what's appended
+    appendFile(path, "ee\nfour\n");
+    CHECK(pDocument->Reload());
+    CHECK(texts(pDocument) == splitLines(readFile(path)));
+    CHECK(lines(pDocument)[0] == before[0]);
+    CHECK(lines(pDocument)[1] == before[1]);
+
+    // a lone CR followed by a LF is one line ending, not two
+    appendFile(path, "five\r");
+    CHECK(pDocument->Reload());
+    appendFile(path, "\nsix");
+    CHECK(pDocument->Reload());
+    CHECK(texts(pDocument) == splitLines(readFile(path)));
+
+    // and a lone CR followed by anything else ends the line
+    appendFile(path, "\r");
+    CHECK(pDocument->Reload());
+    appendFile(path, "seven\n");
+    CHECK(pDocument->Reload());
+    CHECK(texts(pDocument) == splitLines(readFile(path)));
+
+    // a partial line that nothing was added to keeps its LineBuffer
+    appendFile(path, "eight");
+    CHECK(pDocument->Reload());
+    LineBuffer::Ptr pLast = lines(pDocument).back();
+    appendFile(path, "\n");
+    CHECK(pDocument->Reload());
+    CHECK(lines(pDocument).back() == pLast);
+}
+
+static void testSameSizeRewrite()
+{
+    // a generated file whose header changes but whose size and tail don't
+    string path = Test::path("generated.txt");
+    string body;
+    for (int n = 0; n < 1000; n++)
+    {
+        body += "int x" + to_string(n) + ";\n";
+    }
+    writeFile(path, "// generated at 01:00\n" + body);
+    Document::Ptr pDocument = Document::Create();
+    pDocument->Load(path.c_str());
+    LineBuffer::Ptr pSecond = lines(pDocument)[1];
+
+    writeFile(path, "// generated at 02:00\n" + body);
+    CHECK(pDocument->Reload());
+    CHECK(text(lines(pDocument)[0]) == "// generated at 02:00");
+    CHECK(lines(pDocument)[1] == pSecond);
+}
+
+static void testRandomRewrites()
+{
+    // lines from a small set so there are plenty of duplicates for the
+    // matcher to get wrong
+    const char *apkcWords[] = { "{", "}", "", "return x;", "x++;", "int x = 0;", "// comment" };
+    string path = Test::path("random.txt");
+    unsigned int uSeed = 26;
+    auto random = [&uSeed](size_t szRange)
+    {
+        uSeed = uSeed * 1103515245 + 12345;
+        return static_cast<size_t>((uSeed >> 16) % szRange);
+    };
+    auto randomLine = [&]()
+    {
+        return random(3) ? string(apkcWords[random(7)]) : "unique " + to_string(random(100000));
+    };
+
+    vector<string> contents;
+    for (int n = 0; n < 300; n++)
+    {
+        contents.push_back(randomLine());
+    }
+    writeFile(path, join(contents));
+    Document::Ptr pDocument = Document::Create();
+    pDocument->Load(path.c_str());
+
+    for (int nPass = 0; nPass < 60; nPass++)
+    {
+        vector<LineBuffer::Ptr> before = lines(pDocument);
+        size_t szFirstEdit = contents.size();
+        for (size_t szEdit = random(6); szEdit; szEdit--)
+        {
+            size_t szLine = random(contents.size() + 1);
+            szFirstEdit = std::min(szFirstEdit, szLine);
+            switch (random(3))
+            {
+                case 0:
+                    contents.insert(contents.begin() + szLine, randomLine());
+                    break;
+                case 1:
+                    if (szLine < contents.size())
+                    {
+                        contents.erase(contents.begin() + szLine);
+                    }
+                    break;
+                default:
+                    if (szLine < contents.size())
+                    {
+                        contents[szLine] = randomLine();
+                    }
+                    break;
+            }
+        }
+
+        // alternate between rewriting in place and replacing the file
+        if (nPass % 2)
+        {
+            writeFile(path, join(contents));
+        }
+        else
+        {
+            writeFile(path + ".new", join(contents));
+            ::rename((path + ".new").c_str(), path.c_str());
+        }
+
+        CHECK(pDocument->Reload());
+        CHECK(texts(pDocument) == contents);
+
+        // nothing before the first edit was rebuilt
+        vector<LineBuffer::Ptr> after = lines(pDocument);
+        for (size_t sz = 0; sz < szFirstEdit && sz < after.size(); sz++)
+        {
+            CHECK(after[sz] == before[sz]);
+        }
+    }
+}
+
+static void testNulls()
+{
+    // what copytruncate rotation leaves behind
+    string path = Test::path("nulls.txt");
+    writeFile(path, string(3 * 1024 * 1024, '\0') + "hello\nworld\n");
+    Document::Ptr pDocument = Document::Create();
+    CHECK(pDocument->Load(path.c_str()));
+    CHECK(texts(pDocument) == vector<string>({ "hello", "world" }));
+}
+
+static void testConflicts()
+{
+    string path = Test::path("conflict.txt");
+    writeFile(path, "a\nb\n");
+    Document::Ptr pDocument = Document::Create();
+    pDocument->Load(path.c_str());
+
+    // an append leaves edits to lines it doesn't read again alone
+    lines(pDocument)[0]->InsertChars("X");
+    appendFile(path, "c\n");
+    CHECK(pDocument->Reload());
+    CHECK(!pDocument->HasConflict());
+    CHECK(texts(pDocument) == vector<string>({ "aX", "b", "c" }));
+
+    // a rewrite would lose the edit
+    writeFile(path, "new\nb\nc\n");
+    CHECK(!pDocument->Reload());
+    CHECK(pDocument->HasConflict());
+    CHECK(text(lines(pDocument)[0]) == "aX");
+
+    CHECK(pDocument->Reload(true));
+    CHECK(!pDocument->HasConflict());
+    CHECK(texts(pDocument) == vector<string>({ "new", "b", "c" }));
+
+    // discarding applies to every line even when the file only grew
+    lines(pDocument)[0]->InsertChars("Y");
+    appendFile(path, "d\n");
+    CHECK(pDocument->Reload(true));
+    CHECK(texts(pDocument) == vector<string>({ "new", "b", "c", "d" }));
+    CHECK(!lines(pDocument)[0]->IsModified());
+}
+
+static bool isReadable(int fd, int nTimeout)
+{
+    struct pollfd pfd = { fd, POLLIN, 0 };
+    return ::poll(&pfd, 1, nTimeout) == 1;
+}
+
+static void testWatch()
+{
+    string path = Test::path("watched.log");
+    writeFile(path, "one\n");
+    Document::Ptr pDocument = Document::Create();
+    pDocument->Load(path.c_str());
+    int fd = pDocument->GetWatchFd();
+    CHECK(fd >= 0);
+    CHECK(!isReadable(fd, 0));
+
+    appendFile(path, "two\n");
+    CHECK(isReadable(fd, 1000));
+    CHECK(pDocument->CheckForChanges());
+    CHECK(texts(pDocument).size() == 2);
+
+    // rotated away, the fd mustn't stay readable while the file is missing
+    ::rename(path.c_str(), (path + ".1").c_str());
+    CHECK(isReadable(fd, 1000));
+    pDocument->CheckForChanges();
+    pDocument->CheckForChanges();
+    CHECK(!isReadable(fd, 0));
+
+    // and the new file wakes it up
+    writeFile(path, "three\n");
+    CHECK(isReadable(fd, 1000));
+    CHECK(pDocument->CheckForChanges());
+    CHECK(texts(pDocument) == vector<string>({ "three" }));
+}
+
+void runDocumentTests()
+{
+    testLoad();
+    testChunkBoundaries();
+    testAppend();
+    testSameSizeRewrite();
+    testRandomRewrites();
+    testNulls();
+    testConflicts();
+    testWatch();
+}
@@ -0,0 +1,226 @@
+///
+/// @file PagedDocumentTest.cpp
+/// @author Hagen Kaye <hagen.kaye@gmail.com>
+///
+/// @section LICENSE
+/// MIT License
+///
+/// Copyright (c) 2016 Hagen Kaye
+///
+/// Permission is hereby granted, free of charge, to any person obtaining a copy
+/// of this software and associated documentation files (the "Software"), to deal
+/// in the Software without restriction, including without limitation the rights
+/// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+/// copies of the Software, and to permit persons to whom the Software is
+/// furnished to do so, subject to the following conditions:
+///
+/// The above copyright notice and this permission notice shall be included in all
+/// copies or substantial portions of the Software.
+///
+/// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+/// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+/// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+/// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+/// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+/// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+/// SOFTWARE.
+///
+#include "Test.h"
+#include "PagedDocument.h"
+
+using namespace Test;
+
+static const size_t szMegabyte = 1024 * 1024;
+
+static vector<string> texts(PagedDocument::Ptr pDocument)
+{
+    vector<string> result;
+    for (size_t szLine = 0; szLine < pDocument->GetLineCount(); szLine++)
+    {
+        LineBuffer::Ptr pLine = pDocument->GetLine(szLine);
+        result.push_back(pLine ? text(pLine) : "<null>");
+    }
+    return result;
+}
+
+// about szBytes of numbered lines with every kind of line ending
+static string numberedLines(size_t szBytes)
+{
+    const char *apkcEndings[] = { "\n", "\r\n", "\r" };
+    string contents;
+    for (size_t szLine = 0; contents.size() < szBytes; szLine++)
+    {
+        contents += "line " + to_string(szLine) + string(szLine % 97, '.') + apkcEndings[szLine % 3];
+    }
+    return contents;
+}
+
+// the line endings in order
+static vector<string> lineEndings(const string &rContents)
+{
+    vector<string> result;
+    for (size_t sz = 0; sz < rContents.size(); sz++)
+    {
+        if (rContents.compare(sz, 2, "\r\n") == 0)
+        {
+            result.push_back("\r\n");
+            sz++;
+        }
+        else if (rContents[sz] == '\r' || rContents[sz] == '\n')
+        {
+            result.push_back(rContents.substr(sz, 1));
+        }
+    }
+    return result;
+}
+
+static void testScan()
+{
+    // the scan reads 4 MB at a time, put a CRLF across the first boundary and
+    // an empty line after it
+    string path = Test::path("scan.txt");
+    string contents(2 * szMegabyte, 'a');
+    contents += "\n" + string(2 * szMegabyte - 2, 'b') + "\r\n\r\n";
+    contents += numberedLines(3 * szMegabyte);
+    contents += "no line ending";
+    writeFile(path, contents);
+
+    PagedDocument::Ptr pDocument = PagedDocument::Create();
+    CHECK(pDocument->Load(path.c_str()));
+    CHECK(pDocument->GetLineCount() == splitLines(contents).size());
+    CHECK(texts(pDocument) == splitLines(contents));
+    CHECK(!pDocument->GetLine(pDocument->GetLineCount()));
+
+    writeFile(path, "");
+    CHECK(pDocument->Load(path.c_str()));
+    CHECK(pDocument->GetLineCount() == 0);
+
+    // a line over the limit, counting its line ending, is refused and one at
+    // the limit isn't
+    writeFile(path, string(4 * szMegabyte - 1, 'x') + "\n");
+    CHECK(pDocument->Load(path.c_str()));
+    writeFile(path, string(4 * szMegabyte, 'x') + "\n");
+    CHECK(!pDocument->Load(path.c_str()));
+    writeFile(path, string(4 * szMegabyte + 1, 'x'));
+    CHECK(!pDocument->Load(path.c_str()));
+}
+
+static void testSave()
+{
+    string path = Test::path("save.txt");
+    string nulls("with\0null\0s", 11);
+    string contents = numberedLines(3 * szMegabyte) + nulls + "\r\n" + numberedLines(2 * szMegabyte) + "last";
+    writeFile(path, contents);
+
+    // an unmodified document saves the same bytes
+    PagedDocument::Ptr pDocument = PagedDocument::Create();
+    CHECK(pDocument->Load(path.c_str()));
+    CHECK(pDocument->Save());
+    CHECK(readFile(path) == contents);
+
+    // edit a line in the first block, one in the middle and the last, each
+    // keeps its own line ending and the line with nulls is written as it was
+    size_t szMiddle = pDocument->GetLineCount() / 2;
+    size_t szLast = pDocument->GetLineCount() - 1;
+    pDocument->GetLine(1)->InsertChars("first ", 0);
+    pDocument->GetLine(szMiddle)->InsertChars("middle ", 0);
+    pDocument->GetLine(szLast)->InsertChars("final ", 0);
+    vector<string> expected = texts(pDocument);
+    CHECK(pDocument->Save());
+    CHECK(!pDocument->IsStale());
+
+    string saved = readFile(path);
+    CHECK(saved.find(nulls + "\r\n") != string::npos);
+    CHECK(saved.substr(saved.size() - 10) == "final last");
+    CHECK(splitLines(saved).size() == expected.size());
+
+    PagedDocument::Ptr pReloaded = PagedDocument::Create();
+    CHECK(pReloaded->Load(path.c_str()));
+    CHECK(texts(pReloaded) == expected);
+    CHECK(texts(pDocument) == expected);
+
+    // every line kept the line ending it was read with
+    CHECK(lineEndings(saved) == lineEndings(contents));
+}
+
+static void testRefusals()
+{
+    string path = Test::path("refuse.txt");
+    string contents = "one\n" + string("two\0two", 7) + "\nthree\n";
+    writeFile(path, contents);
+    PagedDocument::Ptr pDocument = PagedDocument::Create();
+
+    // a line break inserted into a line
+    CHECK(pDocument->Load(path.c_str()));
+    pDocument->GetLine(0)->InsertChars("\n");
+    CHECK(!pDocument->Save());
+    CHECK(readFile(path) == contents);
+
+    // a changed line that had a null in it
+    CHECK(pDocument->Load(path.c_str()));
+    pDocument->GetLine(1)->InsertChars("x");
+    CHECK(!pDocument->Save());
+    CHECK(readFile(path) == contents);
+
+    // the file changed since it was loaded
+    CHECK(pDocument->Load(path.c_str()));
+    pDocument->GetLine(0)->InsertChars("x");
+    appendFile(path, "four\n");
+    CHECK(pDocument->IsStale());
+    CHECK(!pDocument->Save());
+    CHECK(readFile(path) == contents + "four\n");
+
+    // or was replaced
+    CHECK(pDocument->Load(path.c_str()));
+    writeFile(path + ".new", contents);
+    ::rename((path + ".new").c_str(), path.c_str());
+    CHECK(pDocument->IsStale());
+    CHECK(!pDocument->GetLine(0));
+}
+
+static void testEviction()
+{
+    string path = Test::path("evict.txt");
+    writeFile(path, numberedLines(16 * szMegabyte));
+
+    // the most the budget can be overrun by is the block being read, and
+    // the pinned ones
+    const size_t szBudget = 6 * szMegabyte;
+    const size_t szBlock = 2 * szMegabyte;
+    PagedDocument::Ptr pDocument = PagedDocument::Create(szBudget);
+    CHECK(pDocument->Load(path.c_str()));
+    size_t szLines = pDocument->GetLineCount();
+
+    pDocument->GetLine(0)->InsertChars("edited ", 0);
+    LineBuffer::Ptr pHeld = pDocument->GetLine(szLines / 2);
+    size_t szMaxUsed = 0;
+    for (size_t szLine = 0; szLine < szLines; szLine += 100)
+    {
+        CHECK(pDocument->GetLine(szLine));
+        szMaxUsed = std::max(szMaxUsed, pDocument->GetMemoryUsed());
+    }
+    CHECK(szMaxUsed <= szBudget + 3 * szBlock);
+    CHECK(pDocument->GetMemoryUsed() <= szBudget + 3 * szBlock);
+
+    // the modified and the held blocks stayed
+    CHECK(text(pDocument->GetLine(0)).compare(0, 7, "edited ") == 0);
+    CHECK(pDocument->GetLine(szLines / 2) == pHeld);
+
+    // once saved and let go of they can be dropped like the others
+    CHECK(pDocument->Save());
+    pHeld.reset();
+    for (size_t szLine = 0; szLine < szLines; szLine += 100)
+    {
+        pDocument->GetLine(szLine);
+        CHECK(pDocument->GetMemoryUsed() <= szBudget + szBlock);
+    }
+    CHECK(pDocument->GetLine(1) && !pDocument->GetLine(0)->IsModified());
+}
+
+void runPagedDocumentTests()
+{
+    testScan();
+    testSave();
+    testRefusals();
+    testEviction();
+}
@@ -0,0 +1,106 @@
+///
+/// @file Test.h
+/// @author Hagen Kaye <hagen.kaye@gmail.com>
+///
+/// @section LICENSE
+/// MIT License
+///
+/// Copyright (c) 2016 Hagen Kaye
+///
+/// Permission is hereby granted, free of charge, to any person obtaining a copy
+/// of this software and associated documentation files (the "Software"), to deal
+/// in the Software without restriction, including without limitation the rights
+/// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+/// copies of the Software, and to permit persons to whom the Software is
+/// furnished to do so, subject to the following conditions:
+///
+/// The above copyright notice and this permission notice shall be included in all
+/// copies or substantial portions of the Software.
+///
+/// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+/// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+/// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+/// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+/// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+/// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+/// SOFTWARE.
+///
+/// @section DESCRIPTION
+///
+/// A minimal harness and helpers shared by the tests
+///
+#ifndef Test_h
+#define Test_h
+#include "Platform.h"
+#include "LineBuffer.h"
+
+extern int g_nChecks;
+extern int g_nFailures;
+
+#define CHECK(expr) \
+    do \
+    { \
+        g_nChecks++; \
+        if (!(expr)) \
+        { \
+            g_nFailures++; \
+            cerr << __FILE__ << ":" << __LINE__ << ": CHECK(" #expr ") failed" << endl; \
+        } \
+    } while (0)
+
+namespace Test
+{
+///
+/// Get a path for a scratch file in a directory that's removed after the tests
+///
+/// @param[in] pkcName name of the file
+/// @return the full path
+
+string path(const char *pkcName);
+
+///
+/// Replaces the contents of a file
+///
+/// @param[in] rPath path of the file
+/// @param[in] rContents bytes to write
+
+void writeFile(const string &rPath, const string &rContents);
+
+///
+/// Adds to the end of a file
+///
+/// @param[in] rPath path of the file
+/// @param[in] rContents bytes to append
+
+void appendFile(const string &rPath, const string &rContents);
+
+///
+/// Reads a whole file
+///
+/// @param[in] rPath path of the file
+/// @return the bytes in the file
+
+string readFile(const string &rPath);
+
+///
+/// Splits text into lines the way gee does, CR, LF and CRLF all end a line
+/// and whatever follows the last line ending is a line of its own
+///
+/// @param[in] rContents the text to split
+/// @return the lines without their endings
+
+vector<string> splitLines(const string &rContents);
+
+///
+/// Get the text of a line
+///
+/// @param[in] pLine the line
+/// @return the text
+
+string text(LineBuffer::Ptr pLine);
+}
+
+void runDocumentTests();
+void runPagedDocumentTests();
+
+#endif
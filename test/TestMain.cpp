@@ -0,0 +1,123 @@
+///
+/// @file TestMain.cpp
+/// @author Hagen Kaye <hagen.kaye@gmail.com>
+///
+/// @section LICENSE
+/// MIT License
+///
+/// Copyright (c) 2016 Hagen Kaye
+///
+/// Permission is hereby granted, free of charge, to any person obtaining a copy
+/// of this software and associated documentation files (the "Software"), to deal
+/// in the Software without restriction, including without limitation the rights
+/// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+/// copies of the Software, and to permit persons to whom the Software is
+/// furnished to do so, subject to the following conditions:
+///
+/// The above copyright notice and this permission notice shall be included in all
+/// copies or substantial portions of the Software.
+///
+/// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+/// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+/// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+/// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+/// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+/// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+/// SOFTWARE.
+///
+#include "Test.h"
+
+#include <stdio.h>
+
+int g_nChecks = 0;
+int g_nFailures = 0;
+
+static string s_directory;
+
+string Test::path(const char *pkcName)
+{
+    return s_directory + "/" + pkcName;
+}
+
+void Test::writeFile(const string &rPath, const string &rContents)
+{
+    FILE *pFile = ::fopen(rPath.c_str(), "wb");
+    ::fwrite(rContents.data(), 1, rContents.size(), pFile);
+    ::fclose(pFile);
+}
+
+void Test::appendFile(const string &rPath, const string &rContents)
+{
+    FILE *pFile = ::fopen(rPath.c_str(), "ab");
+    ::fwrite(rContents.data(), 1, rContents.size(), pFile);
+    ::fclose(pFile);
+}
+
+string Test::readFile(const string &rPath)
+{
+    string contents;
+    FILE *pFile = ::fopen(rPath.c_str(), "rb");
+    if (pFile)
+    {
+        char buffer[64 * 1024];
+        size_t szRead;
+        while ((szRead = ::fread(buffer, 1, sizeof(buffer), pFile)) > 0)
+        {
+            contents.append(buffer, szRead);
+        }
+        ::fclose(pFile);
+    }
+    return contents;
+}
+
+vector<string> Test::splitLines(const string &rContents)
+{
+    vector<string> lines;
+    size_t szStart = 0;
+    for (size_t sz = 0; sz < rContents.size(); sz++)
+    {
+        if (rContents[sz] == 0x0a || rContents[sz] == 0x0d)
+        {
+            lines.push_back(rContents.substr(szStart, sz - szStart));
+            if (rContents[sz] == 0x0d && sz + 1 < rContents.size() && rContents[sz + 1] == 0x0a)
+            {
+                sz++;
+            }
+            szStart = sz + 1;
+        }
+    }
+    if (szStart < rContents.size())
+    {
+        lines.push_back(rContents.substr(szStart));
+    }
+    return lines;
+}
+
+string Test::text(LineBuffer::Ptr pLine)
+{
+    string line;
+    pLine->WriteBuffer([&line](const char *pkcBuffer, size_t szBytes)
+    {
+        line.assign(pkcBuffer, szBytes);
+    });
+    return line;
+}
+
+int main()
+{
+    char directory[] = "/tmp/gee-test-XXXXXX";
+    if (::mkdtemp(directory) == nullptr)
+    {
+        cerr << "couldn't create " << directory << endl;
+        return 1;
+    }
+    s_directory = directory;
+
+    runDocumentTests();
+    runPagedDocumentTests();
+
+    ::system(("rm -rf " + s_directory).c_str());
+
+    cout << g_nChecks - g_nFailures << " of " << g_nChecks << " checks passed" << endl;
+    return g_nFailures ? 1 : 0;
+}